@@ -1,13 +1,26 @@
 #include "args.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 void parse_args(int argc, char * argv[], opts_t * opts)
 {
     int i = 0;
-    bool read_term = false;
+    char read_value = '\0';    // option which value is expected in the next argument
     while (++i < argc) {
-        if (read_term) {
+        if (read_value == 'b') {
+            char * arg_end;
+            unsigned long budget = strtoul(argv[i], &arg_end, 10);
+            if (*argv[i] && !*arg_end && budget <= UINT32_MAX) {
+                opts->budget = budget;
+            } else {
+                fprintf(stderr, "** Code size budget '%s' is not a number: ignoring.\n", argv[i]);
+            }
+            read_value = '\0';
+        } else if (read_value == 'p') {
+            opts->profile_filename = argv[i];
+            read_value = '\0';
+        } else if (read_value == 'd') {
             int arg_len = strlen(argv[i]);
             switch (arg_len) {
                 case 0: {
@@ -23,7 +36,7 @@ void parse_args(int argc, char * argv[], opts_t * opts)
                     fprintf(stderr, "** Terminator value is %d characters long: using '%c'.\n", arg_len, opts->term);
                 }
             }
-            read_term = false;
+            read_value = '\0';
         } else if (argv[i][0] == '-') {
             const char * arg = &argv[i][1];
             while (*arg) {
@@ -32,8 +45,14 @@ void parse_args(int argc, char * argv[], opts_t * opts)
                         opts->no_case = true;
                         break;
                     }
-                    case 'd': {
-                        read_term = true;
+                    case 'v': {
+                        opts->verbose = true;
+                        break;
+                    }
+                    case 'd':
+                    case 'b':
+                    case 'p': {
+                        read_value = *arg;
                         break;
                     }
                 }
@@ -2,12 +2,16 @@
 #define __ARGS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /// Program execution options
 typedef struct _opts {
     const char * input_filename;
+    const char * profile_filename;
     bool         no_case;
+    bool         verbose;
     char         term;
+    uint32_t     budget;
 } opts_t;
 
 /**
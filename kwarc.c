@@ -1,6 +1,7 @@
 #include "args.h"
 #include "input.h"
 #include "states.h"
+#include "layout.h"
 #include "output.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,15 +37,31 @@ typedef struct _sm {
     token_list_t  tokens;
 } sm_t;
 
+/**
+ * Checks whether the keyword is a pattern.
+ * \param  keyword      Pointer to the first character of the keyword.
+ * \param  keyword_end  Pointer to the character just after the last character of the keyword.
+ * \return `true` if the keyword has `*` or a character class.
+ */
+static bool is_pattern(const char * keyword, const char * keyword_end)
+{
+    for (; keyword < keyword_end; keyword++) {
+        if (*keyword == '*' || *keyword == '[') {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * Compiles the recognition automaton specification.
- * \param  text      Pointer to the text of the spec.
- * \param  text_end  Pointer to the character jsut after the last character of the spec
+ * \param  spec      Pointer to the text of the spec.
+ * \param  spec_len  Length of the spec.
  * \param  kw_term   Character that is used to terminate keywords.
  * \param  no_case   Option to merge keywords that differ only in their caseness.
  * \return state machine states and the list of tokens
  */
-static sm_t spec_compile(const char * text, uint16_t text_len, char kw_term, bool no_case)
+static sm_t spec_compile(const char * spec, uint16_t spec_len, char kw_term, bool no_case)
 {
     sm_t sm;
     sm.start_state = state_create(0);
@@ -54,36 +71,48 @@ static sm_t spec_compile(const char * text, uint16_t text_len, char kw_term, boo
     uint16_t last_state_no = MAX_TOKEN_ID;
     uint16_t last_token_id = 0;
 
-    const char * text_end = text + text_len;
+    const char * text_end = spec + spec_len;
 
-    while (text < text_end) {
-        // line format = keyword: TOKEN
-        const char * keyword = text;
-        while (text < text_end && *text != '\n' && *text != kw_term) {
-            ++text;
-        }
-        const char * keyword_end = text;
-
-        if (text < text_end && *text == kw_term) {
-            // skip whitespace
-            while (++text < text_end && *text != '\n' && !isgraph(*text)) {}
-            if (text < text_end && isgraph(*text)) {
-                const char * token = text;
-                // find the end of the token
-                while (++text < text_end && isgraph(*text)) {}
-                const char * token_end = text;
-
-                uint16_t last_listed_token_id = last_token_id;
-                const state_t * final_state = 
-                    build_string_matcher( sm.start_state, &last_state_no, &last_token_id
-                                        , keyword, keyword_end - keyword, no_case );
-                if (final_state->no > last_listed_token_id) {
-                    token_list_append(&sm.tokens, token_create(token, token_end, final_state->no));
+    // patterns are built on top of the keyword states, thus they are compiled in the second pass
+    for (int patterns = 0; patterns < 2; patterns++) {
+        const char * text = spec;
+        while (text < text_end) {
+            // line format = keyword: TOKEN
+            const char * keyword = text;
+            while (text < text_end && *text != '\n' && *text != kw_term) {
+                ++text;
+            }
+            const char * keyword_end = text;
+
+            if (text < text_end && *text == kw_term && is_pattern(keyword, keyword_end) == patterns) {
+                // skip whitespace
+                while (++text < text_end && *text != '\n' && !isgraph(*text)) {}
+                if (text < text_end && isgraph(*text)) {
+                    const char * token = text;
+                    // find the end of the token
+                    while (++text < text_end && isgraph(*text)) {}
+                    const char * token_end = text;
+
+                    uint16_t last_listed_token_id = last_token_id;
+                    const char * error = NULL;
+                    const state_t * final_state = patterns
+                        ? build_pattern_matcher( sm.start_state, &last_state_no, &last_token_id
+                                               , keyword, keyword_end - keyword, kw_term, &error )
+                        : build_string_matcher( sm.start_state, &last_state_no, &last_token_id
+                                              , keyword, keyword_end - keyword, no_case );
+                    if (!final_state) {
+                        fprintf(stderr, "** Pattern '%.*s' %s: ignoring.\n", (int) (keyword_end - keyword), keyword, error);
+                    } else if (error) {
+                        fprintf(stderr, "** Pattern '%.*s' %s.\n", (int) (keyword_end - keyword), keyword, error);
+                    }
+                    if (final_state && final_state->no > last_listed_token_id) {
+                        token_list_append(&sm.tokens, token_create(token, token_end, final_state->no));
+                    }
                 }
             }
+            // skip to the next line
+            while (text < text_end && *text++ != '\n') {}
         }
-        // skip to the next line
-        while (text < text_end && *text++ != '\n') {}
     }
     return sm;
 }
@@ -94,13 +123,16 @@ int main(int argc, char * argv[])
 
     // Set up the default values
     opts.input_filename = NULL;
+    opts.profile_filename = NULL;
     opts.no_case = false;   // keywords are case sensitive
+    opts.verbose = false;   // print only the layout summary
     opts.term = ':';        // default keyword-value separator
+    opts.budget = 0;        // code size is not limited
 
     parse_args(argc, argv, &opts);
 
     if (!opts.input_filename) {
-        fprintf(stderr, "Usage: %s [-i] [-d 'term'] <spec_file_name>\n", argv[0]);
+        fprintf(stderr, "Usage: %s [-i] [-v] [-d 'term'] [-b budget] [-p profile] <spec_file_name>\n", argv[0]);
         return 1;
     }
 
@@ -112,8 +144,22 @@ int main(int argc, char * argv[])
 
     if (text) {
         sm_t sm = spec_compile(text, text_length, opts.term, opts.no_case);
-                
-        write_automaton(&sm.tokens, sm.start_state, &output);
+
+        layout_t layout;
+        layout_init(sm.start_state, &layout);
+        if (opts.profile_filename) {
+            uint16_t profile_length;
+            const char * profile = read_file(opts.profile_filename, &profile_length);
+            if (profile) {
+                layout_count_visits(&layout, profile, profile_length, opts.term);
+            } else {
+                fprintf(stderr, "** Cannot read profile '%s': ignoring.\n", opts.profile_filename);
+            }
+        }
+        layout_plan(&layout, opts.budget);
+        layout_print(&layout, output.lowercase_prefix, opts.verbose, stdout);
+
+        write_automaton(&sm.tokens, sm.start_state, &layout, &output);
     }
 
     return 0;
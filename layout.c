@@ -0,0 +1,466 @@
+#include "layout.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/// Weight of the most frequently visited states.
+#define MAX_WEIGHT      64
+
+/// Size of code (in bytes) that is worth as much as a single branch executed in a state with weight 1.
+#define BRANCH_BYTES    16
+
+/// The shortest text that the scanner compares in bulk.
+#define CHAIN_MIN_LEN   4
+
+/// Estimated size of the code of a single `case` of the `next_state` function.
+#define CASE_BYTES      4
+
+/// Estimated size of the code of the scanner and the `next_state` outside the states.
+#define BASE_BYTES      64
+
+/// Estimated size of the `switch` that the scanner executes for every character when there are chains.
+#define DISPATCH_BYTES  16
+
+/// Names of the shapes as they are printed in the layout summary.
+static const char * const shape_names[NUM_SHAPES] = { "compare", "bitmap", "table" };
+
+uint16_t group_transitions(const state_t * state, transition_group_t * groups)
+{
+    uint16_t num_groups = 0;
+    for (int i = 0; i < state->num_matches; i++) {
+        uint8_t match = state->matches[i];
+        transition_group_t * group = groups;
+        transition_group_t * groups_end = groups + num_groups;
+        while (group < groups_end && group->goto_state != state->goto_states[i]) {
+            ++group;
+        }
+        if (group == groups_end) {
+            group->goto_state = state->goto_states[i];
+            group->first = match;
+            group->span = 1;
+            group->count = 0;
+            ++num_groups;
+        } else if (match < group->first) {
+            group->span += group->first - match;
+            group->first = match;
+        } else if (match - group->first >= group->span) {
+            group->span = match - group->first + 1;
+        }
+        ++group->count;
+    }
+    for (transition_group_t * group = groups; group < groups + num_groups; group++) {
+        group->mask = 0;
+        if (group->span <= 64) {
+            for (int i = 0; i < state->num_matches; i++) {
+                if (state->goto_states[i] == group->goto_state) {
+                    group->mask |= (uint64_t) 1 << ((uint8_t) state->matches[i] - group->first);
+                }
+            }
+        }
+    }
+    return num_groups;
+}
+
+/**
+ * Finds the layout of a state.
+ * \param  layout  The automaton layout.
+ * \param  state   State to look for.
+ * \return Pointer to the state layout or NULL if the state has not been added to the layout yet.
+ */
+static state_layout_t * layout_find(const layout_t * layout, const state_t * state)
+{
+    for (state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+        if (sl->state == state) {
+            return sl;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Appends a state to the layout.
+ * \param  layout  The automaton layout.
+ * \param  state   State to append.
+ * \param  depth   Length of the shortest text that leads to the state.
+ */
+static void layout_append(layout_t * layout, state_t * state, uint16_t depth)
+{
+    if (layout->num_states == layout->max_states) {
+        layout->max_states += 64;
+        layout->states = realloc(layout->states, sizeof(state_layout_t) * layout->max_states);
+    }
+    state_layout_t * sl = &layout->states[layout->num_states++];
+    memset(sl, 0, sizeof(state_layout_t));
+    sl->state = state;
+    sl->depth = depth;
+}
+
+void layout_init(state_t * start_state, layout_t * layout)
+{
+    layout->states = NULL;
+    layout->num_states = 0;
+    layout->max_states = 0;
+    layout->profiled = false;
+    layout->budget = 0;
+    layout->bytes = 0;
+
+    // breadth-first traversal records the shortest path to each state
+    layout_append(layout, start_state, 0);
+    for (uint16_t i = 0; i < layout->num_states; i++) {
+        state_t * state = layout->states[i].state;
+        uint16_t depth = layout->states[i].depth;
+        for (int j = 0; j < state->num_matches; j++) {
+            if (!layout_find(layout, state->goto_states[j])) {
+                layout_append(layout, state->goto_states[j], depth + 1);
+            }
+        }
+        if (state->default_state && !layout_find(layout, state->default_state)) {
+            layout_append(layout, state->default_state, depth + 1);
+        }
+    }
+}
+
+/**
+ * Finds the transition of a state on the specified character.
+ * \param  state  State to examine.
+ * \param  match  Character to match.
+ * \return State to transition to or NULL if the state rejects the character.
+ */
+static state_t * state_next(const state_t * state, char match)
+{
+    for (int i = 0; i < state->num_matches; i++) {
+        if (state->matches[i] == match) {
+            return state->goto_states[i];
+        }
+    }
+    return state->default_state;
+}
+
+void layout_count_visits(layout_t * layout, const char * text, uint16_t text_len, char kw_term)
+{
+    const char * text_end = text + text_len;
+    while (text < text_end) {
+        // line format = text: count
+        const char * sample = text;
+        while (text < text_end && *text != '\n' && *text != kw_term) {
+            ++text;
+        }
+        const char * sample_end = text;
+        if (sample_end > sample && sample_end[-1] == '\r') {
+            --sample_end;
+        }
+        uint32_t count = 1;
+        if (text < text_end && *text == kw_term) {
+            // skip whitespace
+            while (++text < text_end && *text != '\n' && !isgraph(*text)) {}
+            if (text < text_end && isdigit(*text)) {
+                unsigned long n = strtoul(text, NULL, 10);
+                count = n < UINT32_MAX ? n : UINT32_MAX;
+            }
+        }
+        if (sample_end > sample) {
+            const state_t * state = layout->states[0].state;
+            for (const char * ptr = sample; state; ptr++) {
+                state_layout_t * sl = layout_find(layout, state);
+                // saturate rather than wrap around when counts are huge
+                sl->visits = sl->visits < UINT32_MAX - count ? sl->visits + count : UINT32_MAX;
+                if (ptr == sample_end || (ptr > sample && state->no <= MAX_TOKEN_ID)) {
+                    break;
+                }
+                state = state_next(state, *ptr);
+            }
+        }
+        // skip to the next line
+        while (text < text_end && *text++ != '\n') {}
+    }
+    layout->profiled = true;
+}
+
+/// Returns the number of bits needed to represent the number.
+static uint8_t bit_width(uint16_t n)
+{
+    uint8_t width = 0;
+    for (; n; n >>= 1) {
+        ++width;
+    }
+    return width;
+}
+
+/**
+ * Estimates the size of the code and the number of branches of each shape of the state.
+ * \param  sl  State layout to update.
+ */
+static void estimate_shapes(state_layout_t * sl)
+{
+    const state_t * state = sl->state;
+    uint16_t n = state->num_matches;
+
+    // compare tree: linear tests of up to 3 characters at the bottom
+    sl->bytes[SHAPE_COMPARE] = 8 * n + 2 * (n > 3 ? n - 3 : 0) + (state->default_state ? 4 : 0);
+    sl->branches[SHAPE_COMPARE] = n <= 3 ? n : bit_width(n);
+
+    // bitmap: each group of characters that leads to the same state is tested with a single mask
+    transition_group_t groups[256];
+    uint16_t num_groups = group_transitions(state, groups);
+    bool has_bitmap = false;
+    uint16_t bitmap_bytes = 0;
+    for (uint16_t i = 0; i < num_groups; i++) {
+        if (groups[i].count == 1) {
+            bitmap_bytes += 8;
+        } else if (groups[i].span <= 64) {
+            bitmap_bytes += 20;
+            has_bitmap = true;
+        } else {
+            bitmap_bytes += 8 * groups[i].count;
+        }
+    }
+    sl->bytes[SHAPE_BITMAP] = has_bitmap ? bitmap_bytes : 0;
+    sl->branches[SHAPE_BITMAP] = num_groups;
+
+    // table: a single bounds check and a load
+    if (n >= 3) {
+        uint8_t lo = UINT8_MAX;
+        uint8_t hi = 0;
+        for (int i = 0; i < n; i++) {
+            uint8_t match = state->matches[i];
+            if (match < lo) lo = match;
+            if (match > hi) hi = match;
+        }
+        sl->bytes[SHAPE_TABLE] = 16 + 2 * (hi - lo + 1);
+    } else {
+        sl->bytes[SHAPE_TABLE] = 0;
+    }
+    sl->branches[SHAPE_TABLE] = 1;
+}
+
+/// Estimated cost of executing the state code in the specified shape.
+static uint32_t shape_cost(const state_layout_t * sl, shape_t shape)
+{
+    return (uint32_t) sl->weight * sl->branches[shape] * BRANCH_BYTES + sl->bytes[shape];
+}
+
+/// Returns the applicable shape of the state with the smallest code.
+static shape_t smallest_shape(const state_layout_t * sl)
+{
+    shape_t smallest = SHAPE_COMPARE;
+    for (shape_t shape = SHAPE_COMPARE; shape < NUM_SHAPES; shape++) {
+        if (sl->bytes[shape] > 0 && sl->bytes[shape] < sl->bytes[smallest]) {
+            smallest = shape;
+        }
+    }
+    return smallest;
+}
+
+/// Estimated size of the code that compares the chain in bulk.
+static uint16_t chain_bytes(const state_layout_t * sl)
+{
+    return sl->chain_len > 0 ? 24 + sl->chain_len : 0;
+}
+
+/**
+ * Drops the chain that starts in the specified state.
+ * \param  layout  The automaton layout.
+ * \param  sl      Layout of the state where the chain starts.
+ */
+static void drop_chain(layout_t * layout, state_layout_t * sl)
+{
+    if (sl->chain_len == 0) {
+        return;
+    }
+    layout->bytes -= chain_bytes(sl);
+    sl->chain_len = 0;
+    sl->chain_end = NULL;
+    // states might be shared by several chains, thus marks are recomputed from the remaining ones
+    for (state_layout_t * step = layout->states; step < layout->states + layout->num_states; step++) {
+        step->in_chain = false;
+    }
+    for (const state_layout_t * head = layout->states; head < layout->states + layout->num_states; head++) {
+        if (head->chain_len > 0) {
+            for (const state_t * state = head->state->goto_states[0]; state != head->chain_end; state = state->goto_states[0]) {
+                layout_find(layout, state)->in_chain = true;
+            }
+        }
+    }
+}
+
+/**
+ * Drops all chains if the bulk compares save less than the scanner spends checking for them.
+ * \param  layout  The automaton layout.
+ *
+ * When there are chains the scanner dispatches on the state before it steps over every character,
+ * thus each character scanned in any state costs one more branch. A chain saves the steps through
+ * its states but costs one branch to compare the text.
+ */
+static void check_chains(layout_t * layout)
+{
+    uint32_t saved = 0;
+    uint32_t spent = DISPATCH_BYTES;
+    for (state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+        if (sl->state->num_matches == 0 && !sl->state->default_state) {
+            continue;
+        }
+        if (!sl->in_chain) {
+            // states inside chains are skipped by the bulk compare
+            spent += (uint32_t) sl->weight * BRANCH_BYTES;
+        }
+        if (sl->chain_len > 0) {
+            spent += chain_bytes(sl) + (uint32_t) sl->weight * BRANCH_BYTES;
+            for (const state_t * state = sl->state; state != sl->chain_end; state = state->goto_states[0]) {
+                const state_layout_t * step = layout_find(layout, state);
+                // a step is the state code, the call and the test of the next state
+                saved += (uint32_t) step->weight * (step->branches[step->shape] + 2) * BRANCH_BYTES;
+            }
+        }
+    }
+    if (saved <= spent) {
+        for (state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+            drop_chain(layout, sl);
+        }
+    }
+}
+
+/// Returns whether any state of the layout has a chain.
+static bool has_chains(const layout_t * layout)
+{
+    for (const state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+        if (sl->chain_len > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Finds the chain of single transition states that starts in the specified state.
+ * \param  layout  The automaton layout.
+ * \param  sl      Layout of the state where the chain starts.
+ */
+static void find_chain(layout_t * layout, state_layout_t * sl)
+{
+    uint16_t len = 0;
+    const state_t * state = sl->state;
+    while (state->num_matches == 1 && !state->default_state && len < UINT8_MAX) {
+        ++len;
+        state = state->goto_states[0];
+        if (state->no <= MAX_TOKEN_ID) {
+            // the scanner stops at the first recognized token
+            break;
+        }
+    }
+    if (len >= CHAIN_MIN_LEN) {
+        sl->chain_len = len;
+        sl->chain_end = (state_t *) state;
+        // states inside the chain are only entered when the scan resumes
+        state = sl->state->goto_states[0];
+        while (state != sl->chain_end) {
+            layout_find(layout, state)->in_chain = true;
+            state = state->goto_states[0];
+        }
+    }
+}
+
+void layout_plan(layout_t * layout, uint32_t budget)
+{
+    uint32_t max_visits = 0;
+    for (state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+        if (sl->visits > max_visits) {
+            max_visits = sl->visits;
+        }
+    }
+
+    layout->budget = budget;
+    layout->bytes = BASE_BYTES;
+    for (state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+        if (layout->profiled && max_visits > 0) {
+            sl->weight = 1 + (uint64_t) (MAX_WEIGHT - 1) * sl->visits / max_visits;
+        } else {
+            // without a profile the states closer to the start are assumed to be visited more often
+            sl->weight = sl->depth < 6 ? MAX_WEIGHT >> sl->depth : 1;
+        }
+        if (sl->state->num_matches == 0 && !sl->state->default_state) {
+            continue;
+        }
+        estimate_shapes(sl);
+        sl->shape = SHAPE_COMPARE;
+        for (shape_t shape = SHAPE_BITMAP; shape < NUM_SHAPES; shape++) {
+            if (sl->bytes[shape] > 0 && shape_cost(sl, shape) < shape_cost(sl, sl->shape)) {
+                sl->shape = shape;
+            }
+        }
+        // layouts are in the breadth-first order, thus chains are found from their first state
+        if (!sl->in_chain) {
+            find_chain(layout, sl);
+        }
+        layout->bytes += CASE_BYTES + sl->bytes[sl->shape] + chain_bytes(sl);
+    }
+    check_chains(layout);
+    if (has_chains(layout)) {
+        layout->bytes += DISPATCH_BYTES;
+    }
+
+    // shrink the least frequently visited states until the code fits the budget
+    while (budget > 0 && layout->bytes > budget) {
+        state_layout_t * victim = NULL;
+        for (state_layout_t * sl = layout->states + layout->num_states; sl-- > layout->states;) {
+            if ((sl->state->num_matches > 0 || sl->state->default_state) && (sl->chain_len > 0 || sl->shape != smallest_shape(sl))) {
+                if (!victim || sl->weight < victim->weight) {
+                    victim = sl;
+                }
+            }
+        }
+        if (!victim) {
+            fprintf(stderr, "** Estimated code size %u exceeds the budget of %u bytes.\n", layout->bytes, budget);
+            break;
+        }
+        if (victim->chain_len > 0) {
+            drop_chain(layout, victim);
+            if (!has_chains(layout)) {
+                layout->bytes -= DISPATCH_BYTES;
+            }
+        } else {
+            shape_t shape = smallest_shape(victim);
+            layout->bytes -= victim->bytes[victim->shape] - victim->bytes[shape];
+            victim->shape = shape;
+        }
+    }
+    // the chains that were kept might no longer pay for the dispatch
+    if (has_chains(layout)) {
+        check_chains(layout);
+        if (!has_chains(layout)) {
+            layout->bytes -= DISPATCH_BYTES;
+        }
+    }
+}
+
+void layout_print(const layout_t * layout, const char * name, bool verbose, FILE * out)
+{
+    uint16_t num_shapes[NUM_SHAPES] = { 0 };
+    uint16_t num_chains = 0;
+    for (const state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+        if (sl->state->num_matches == 0 && !sl->state->default_state) {
+            continue;
+        }
+        ++num_shapes[sl->shape];
+        if (sl->chain_len > 0) {
+            ++num_chains;
+        }
+        if (verbose) {
+            fprintf(out, "  state %u: depth %u, weight %u, %s (%u bytes, %u branches)",
+                    sl->state->no, sl->depth, sl->weight, shape_names[sl->shape],
+                    sl->bytes[sl->shape], sl->branches[sl->shape]);
+            if (sl->chain_len > 0) {
+                fprintf(out, ", chain of %u to %u", sl->chain_len, sl->chain_end->no);
+            }
+            fprintf(out, "\n");
+        }
+    }
+    fprintf(out, "%s: %u states:", name, layout->num_states);
+    for (shape_t shape = SHAPE_COMPARE; shape < NUM_SHAPES; shape++) {
+        fprintf(out, " %u %s,", num_shapes[shape], shape_names[shape]);
+    }
+    fprintf(out, " %u chains; ~%u bytes", num_chains, layout->bytes);
+    if (layout->budget > 0) {
+        fprintf(out, " (budget %u)", layout->budget);
+    }
+    fprintf(out, "\n");
+}
\ No newline at end of file
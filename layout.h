@@ -0,0 +1,97 @@
+#ifndef __LAYOUT_H
+#define __LAYOUT_H
+
+#include "states.h"
+#include <stdio.h>
+
+/// Shapes of the code that selects the next state of the automaton
+typedef enum _shape {
+    SHAPE_COMPARE,      ///< Sorted compare tree (a plain `if` for a single transition)
+    SHAPE_BITMAP,       ///< Bitmap tests of characters that lead to the same state
+    SHAPE_TABLE,        ///< Dense lookup table indexed by the character
+    NUM_SHAPES
+} shape_t;
+
+/// Code layout selected for a single state
+typedef struct _state_layout {
+    state_t *   state;                      ///< The laid out state
+    uint16_t    depth;                      ///< Length of the shortest text that leads to this state
+    uint32_t    visits;                     ///< Number of times profile texts pass through this state
+    uint8_t     weight;                     ///< Relative visit frequency (1 to MAX_WEIGHT)
+    shape_t     shape;                      ///< Selected shape of the state
+    uint16_t    bytes[NUM_SHAPES];          ///< Estimated size of the code of each shape (0 if not applicable)
+    uint8_t     branches[NUM_SHAPES];       ///< Estimated number of branches executed by each shape
+    uint8_t     chain_len;                  ///< Length of the text the scanner compares in bulk (0 if none)
+    state_t *   chain_end;                  ///< State the bulk compare leads to
+    bool        in_chain;                   ///< Whether state is in the middle of a bulk compared chain
+} state_layout_t;
+
+/// Code layout of the whole automaton
+typedef struct _layout {
+    state_layout_t *    states;             ///< Layouts of the reachable states in the breadth-first order
+    uint16_t            num_states;
+    uint16_t            max_states;
+    bool                profiled;           ///< Whether visits were counted from a profile
+    uint32_t            budget;             ///< Code size budget (0 if unlimited)
+    uint32_t            bytes;              ///< Estimated size of the code of the automaton
+} layout_t;
+
+/// Group of transitions of a state to the same next state
+typedef struct _transition_group {
+    state_t *   goto_state;                 ///< State to transition to
+    uint8_t     first;                      ///< The smallest character that leads to the `goto_state`
+    uint16_t    span;                       ///< Number of characters from the `first` to the largest one
+    uint16_t    count;                      ///< Number of characters that lead to the `goto_state`
+    uint64_t    mask;                       ///< Bit N is set if `first` + N leads to the `goto_state` (span <= 64)
+} transition_group_t;
+
+/**
+ * Groups transitions of the state by their destination.
+ * \param       state   State which transitions are grouped.
+ * \param[out]  groups  Array of at least `state->num_matches` groups.
+ * \return Number of groups.
+ */
+uint16_t group_transitions(const state_t * state, transition_group_t * groups);
+
+/**
+ * Collects the states of the automaton into the layout.
+ * \param  start_state  The starting state of the automaton.
+ * \param  layout       Layout to initialize.
+ */
+void layout_init(state_t * start_state, layout_t * layout);
+
+/**
+ * Counts visits of states by texts listed in the profile.
+ * \param  layout    Initialized layout.
+ * \param  text      Text of the profile.
+ * \param  text_len  Length of the profile text.
+ * \param  kw_term   Character that terminates the profiled texts.
+ *
+ * Each non-empty line of the profile is a text (as it would appear in the spec), the terminator, and
+ * optionally the number of times this text was seen. The count defaults to 1.
+ */
+void layout_count_visits(layout_t * layout, const char * text, uint16_t text_len, char kw_term);
+
+/**
+ * Selects the shape of every state and the chains that the scanner compares in bulk.
+ * \param  layout  Initialized layout.
+ * \param  budget  Code size budget in bytes. 0 if the size is not limited.
+ *
+ * Each state gets the shape that minimizes the cost estimated as the number of executed branches
+ * weighted by the state visit frequency plus the size of the code. Chains are kept only if the steps
+ * they skip cost more than the check for a chain the scanner makes before every character. If the
+ * estimated size exceeds the budget, the least frequently visited states are switched to their smallest
+ * shapes.
+ */
+void layout_plan(layout_t * layout, uint32_t budget);
+
+/**
+ * Prints a summary of the layout.
+ * \param  layout   Planned layout.
+ * \param  name     Name of the automaton.
+ * \param  verbose  Whether to list the layout of every state.
+ * \param  out      Output file.
+ */
+void layout_print(const layout_t * layout, const char * name, bool verbose, FILE * out);
+
+#endif
\ No newline at end of file
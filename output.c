@@ -47,41 +47,389 @@ void make_output_names(const char * input_filename, output_t * output)
 }
 
 /**
- * Writes a single state case block.
- * \param  state  State of the name recognition automaton.
+ * Writes a character as a C constant.
+ * \param  c    Character to write.
+ * \param  out  Output file.
  */
-static void write_state(state_t * state, FILE * out)
+static void write_char(char c, FILE * out)
 {
-    if (state->num_matches > 0 && state->no < 0x8000) {
-        fprintf(out, "\t\tcase %u: {\n", state->no);
-        if (state->num_matches == 1) {
-            const char * fmt = isprint(state->matches[0])
-                             ? "\t\t\tif (next_char == '%c') return %u;\n"
-                             : "\t\t\tif (next_char == %u) return %u;\n";
-            fprintf(out, fmt, state->matches[0], state->goto_states[0]->no);
+    if (c == '\'' || c == '\\') {
+        fprintf(out, "'\\%c'", c);
+    } else if (isprint((uint8_t) c)) {
+        fprintf(out, "'%c'", c);
+    } else {
+        fprintf(out, "%u", (uint8_t) c);
+    }
+}
+
+/**
+ * Writes a test of the next character for equality with the match.
+ * \param  match  Character to match.
+ * \param  out    Output file.
+ */
+static void write_match_test(char match, FILE * out)
+{
+    fprintf(out, isprint((uint8_t) match) ? "next_char == " : "(uint8_t) next_char == ");
+    write_char(match, out);
+}
+
+/**
+ * Writes tabs that indent the generated code.
+ * \param  indent  Number of tabs.
+ * \param  out     Output file.
+ */
+static void write_indent(int indent, FILE * out)
+{
+    while (indent-- > 0) {
+        fputc('\t', out);
+    }
+}
+
+/**
+ * Writes a sorted compare tree of transitions.
+ * \param  state    State which transitions are written.
+ * \param  order    Indexes of transitions sorted by their characters.
+ * \param  first    Index of the first transition (in `order`) to write.
+ * \param  last     Index of the transition (in `order`) just after the last one to write.
+ * \param  indent   Number of tabs to indent the code with.
+ * \param  out      Output file.
+ */
+static void write_compare_tree(const state_t * state, const uint8_t * order, int first, int last, int indent, FILE * out)
+{
+    if (last - first <= 3) {
+        for (int i = first; i < last; i++) {
+            write_indent(indent, out);
+            fprintf(out, "if (");
+            write_match_test(state->matches[order[i]], out);
+            fprintf(out, ") return %u;\n", state->goto_states[order[i]]->no);
+        }
+    } else {
+        int mid = (first + last) / 2;
+        write_indent(indent, out);
+        fprintf(out, "if ((uint8_t) next_char < ");
+        write_char(state->matches[order[mid]], out);
+        fprintf(out, ") {\n");
+        write_compare_tree(state, order, first, mid, indent + 1, out);
+        write_indent(indent, out);
+        fprintf(out, "} else {\n");
+        write_compare_tree(state, order, mid, last, indent + 1, out);
+        write_indent(indent, out);
+        fprintf(out, "}\n");
+    }
+}
+
+/**
+ * Writes transitions of a state as bitmap tests of characters that lead to the same state.
+ * \param  state  State which transitions are written.
+ * \param  out    Output file.
+ */
+static void write_bitmap_tests(const state_t * state, FILE * out)
+{
+    transition_group_t groups[256];
+    uint16_t num_groups = group_transitions(state, groups);
+    for (const transition_group_t * group = groups; group < groups + num_groups; group++) {
+        if (group->count == 1) {
+            fprintf(out, "\t\t\tif (");
+            write_match_test(group->first, out);
+            fprintf(out, ") return %u;\n", group->goto_state->no);
+        } else if (group->span <= 64) {
+            fprintf(out, "\t\t\tif ((uint8_t) (next_char - ");
+            write_char(group->first, out);
+            fprintf(out, ") < %u", group->span);
+            if (group->count < group->span) {
+                fprintf(out, " && (UINT64_C(0x%016llx) >> (uint8_t) (next_char - ", (unsigned long long) group->mask);
+                write_char(group->first, out);
+                fprintf(out, ") & 1)");
+            }
+            fprintf(out, ") return %u;\n", group->goto_state->no);
         } else {
-            fprintf(out, "\t\t\tswitch (next_char) {\n");
             for (int i = 0; i < state->num_matches; i++) {
-                const char * fmt = isprint(state->matches[i])
-                                 ? "\t\t\t\tcase '%c': return %u;\n"
-                                 : "\t\t\t\tcase %u: return %u;\n";
-                fprintf(out, fmt, state->matches[i], state->goto_states[i]->no);
+                if (state->goto_states[i] == group->goto_state) {
+                    fprintf(out, "\t\t\tif (");
+                    write_match_test(state->matches[i], out);
+                    fprintf(out, ") return %u;\n", group->goto_state->no);
+                }
             }
-            fprintf(out, "\t\t\t}\n");
         }
-        fprintf(out, "\t\t\tbreak;\n");
+    }
+}
+
+/**
+ * Writes transitions of a state as a lookup table indexed by the character.
+ * \param  state  State which transitions are written.
+ * \param  out    Output file.
+ */
+static void write_lookup_table(const state_t * state, FILE * out)
+{
+    uint16_t goto_states[256];
+    uint8_t lo = UINT8_MAX;
+    uint8_t hi = 0;
+    for (int c = 0; c <= UINT8_MAX; c++) {
+        goto_states[c] = state->default_state ? state->default_state->no : 0;
+    }
+    for (int i = 0; i < state->num_matches; i++) {
+        uint8_t match = state->matches[i];
+        goto_states[match] = state->goto_states[i]->no;
+        if (match < lo) lo = match;
+        if (match > hi) hi = match;
+    }
+    fprintf(out, "\t\t\tstatic const uint16_t next_states[%u] = {", hi - lo + 1);
+    for (int c = lo; c <= hi; c++) {
+        fprintf(out, (c - lo) % 16 == 0 ? "\n\t\t\t\t%u," : " %u,", goto_states[c]);
+    }
+    fprintf(out, "\n\t\t\t};\n");
+    fprintf(out, "\t\t\tif ((uint8_t) (next_char - ");
+    write_char(lo, out);
+    fprintf(out, ") < %u) return next_states[(uint8_t) (next_char - ", hi - lo + 1);
+    write_char(lo, out);
+    fprintf(out, ")];\n");
+}
+
+/**
+ * Writes a single state case block.
+ * \param  sl   Layout of the state of the name recognition automaton.
+ * \param  out  Output file.
+ */
+static void write_state(const state_layout_t * sl, FILE * out)
+{
+    const state_t * state = sl->state;
+    if (state->num_matches > 0 || state->default_state) {
+        fprintf(out, "\t\tcase %u: {\n", state->no);
+        switch (sl->shape) {
+            case SHAPE_BITMAP: {
+                write_bitmap_tests(state, out);
+                break;
+            }
+            case SHAPE_TABLE: {
+                write_lookup_table(state, out);
+                break;
+            }
+            default: {
+                uint8_t order[256];
+                for (int i = 0; i < state->num_matches; i++) {
+                    int j = i;
+                    for (; j > 0 && (uint8_t) state->matches[order[j - 1]] > (uint8_t) state->matches[i]; j--) {
+                        order[j] = order[j - 1];
+                    }
+                    order[j] = i;
+                }
+                write_compare_tree(state, order, 0, state->num_matches, 3, out);
+            }
+        }
+        if (state->default_state) {
+            fprintf(out, "\t\t\treturn %u;\n", state->default_state->no);
+        } else {
+            fprintf(out, "\t\t\tbreak;\n");
+        }
         fprintf(out, "\t\t}\n");
+    }
+}
 
-        // mark state as written
-        state->no |= 0x8000;
+/**
+ * Writes a text as a C string literal.
+ * \param  text  Text to write.
+ * \param  len   Length of the text.
+ * \param  out   Output file.
+ */
+static void write_string(const char * text, uint8_t len, FILE * out)
+{
+    fputc('"', out);
+    for (const char * end = text + len; text < end; text++) {
+        if (*text == '"' || *text == '\\' || *text == '?') {
+            fprintf(out, "\\%c", *text);
+        } else if (isprint((uint8_t) *text)) {
+            fputc(*text, out);
+        } else {
+            fprintf(out, "\\%03o", (uint8_t) *text);
+        }
+    }
+    fputc('"', out);
+}
 
-        for (int i = 0; i < state->num_matches; i++) {
-            write_state(state->goto_states[i], out);
+/**
+ * Writes the bulk comparison of the chain of single transition states.
+ * \param  sl      Layout of the state where the chain starts.
+ * \param  output  Pointer to the initialized output names structure.
+ * \param  out     Output file.
+ */
+static void write_chain(const state_layout_t * sl, const output_t * output, FILE * out)
+{
+    char text[UINT8_MAX];
+    const state_t * state = sl->state;
+    for (uint8_t i = 0; i < sl->chain_len; i++) {
+        text[i] = state->matches[0];
+        state = state->goto_states[0];
+    }
+    fprintf(out, "\t\t\tcase %u: {\n"
+                 "\t\t\t\tif (end - ptr >= %u && memcmp(ptr, ", sl->state->no, sl->chain_len);
+    write_string(text, sl->chain_len, out);
+    fprintf(out, ", %u) == 0) {\n"
+                 "\t\t\t\t\tptr += %u;\n", sl->chain_len, sl->chain_len);
+    if (sl->chain_end->no <= MAX_TOKEN_ID) {
+        fprintf(out, "\t\t\t\t\treturn (%s_scan_result_t){ %u, ptr - start };\n",
+                output->lowercase_prefix, sl->chain_end->no);
+    } else {
+        fprintf(out, "\t\t\t\t\tstate = %u;\n"
+                     "\t\t\t\t\tcontinue;\n", sl->chain_end->no);
+    }
+    fprintf(out, "\t\t\t\t}\n"
+                 "\t\t\t\tbreak;\n"
+                 "\t\t\t}\n");
+}
+
+/// The longest text (in bytes) that the packed scanner recognizes with a single 64-bit load.
+#define PACKED_KEY_MAX_LEN  8
+
+/// The maximum number of texts the packed scanner is allowed to dispatch on.
+#define PACKED_MAX_KEYS     1024
+
+/// Text that takes the automaton from the starting state to a token packed into a little-endian integer.
+typedef struct _packed_key {
+    uint64_t  value;        ///< Bytes of the text, the first one in the least significant byte
+    uint8_t   length;       ///< Length of the text
+    uint16_t  id;           ///< ID of the token recognized by the automaton at the end of the text
+} packed_key_t;
+
+/// A collection of packed keys.
+typedef struct _packed_keys {
+    packed_key_t *  keys;
+    uint16_t        num_keys;
+    uint16_t        max_keys;
+} packed_keys_t;
+
+/**
+ * Collects all texts that lead the automaton from the specified state to a token.
+ * \param  state   Current state of the automaton.
+ * \param  value   Bytes of the text scanned so far packed into an integer.
+ * \param  length  Number of bytes scanned so far.
+ * \param  keys    Collection of packed keys to append to.
+ * \return `false` if the automaton cannot be handled by the packed scanner, i.e. when it needs to scan
+ *         more than PACKED_KEY_MAX_LEN bytes to recognize a token or recognizes too many texts.
+ */
+static bool collect_packed_keys(const state_t * state, uint64_t value, uint8_t length, packed_keys_t * keys)
+{
+    if (length > 0 && state->no <= MAX_TOKEN_ID) {
+        // the scanner stops at the first recognized token, thus there is no need to look any further
+        if (keys->num_keys == PACKED_MAX_KEYS) {
+            return false;
+        }
+        if (keys->num_keys == keys->max_keys) {
+            keys->max_keys += 32;
+            keys->keys = realloc(keys->keys, sizeof(packed_key_t) * keys->max_keys);
+        }
+        packed_key_t * key = &keys->keys[keys->num_keys++];
+        key->value = value;
+        key->length = length;
+        key->id = state->no;
+        return true;
+    }
+    if (length == PACKED_KEY_MAX_LEN || state->default_state) {
+        // patterns with `*` and negated classes match too many texts
+        return false;
+    }
+    for (int i = 0; i < state->num_matches; i++) {
+        uint64_t next_value = value | (uint64_t) (uint8_t) state->matches[i] << (8 * length);
+        if (!collect_packed_keys(state->goto_states[i], next_value, length + 1, keys)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Orders packed keys by their length and then by their value.
+static int packed_key_cmp(const void * a, const void * b)
+{
+    const packed_key_t * key_a = a;
+    const packed_key_t * key_b = b;
+    if (key_a->length != key_b->length) {
+        return key_a->length < key_b->length ? -1 : 1;
+    }
+    return key_a->value < key_b->value ? -1 : key_a->value > key_b->value;
+}
+
+/**
+ * Writes the text of a packed key in a form that can be safely embedded into a C comment.
+ * \param  key  The packed key.
+ * \param  out  Output file.
+ */
+static void write_packed_key_text(const packed_key_t * key, FILE * out)
+{
+    char prev = '\0';
+    for (int i = 0; i < key->length; i++) {
+        char c = (char) (key->value >> (8 * i));
+        if (isprint((uint8_t) c) && !(prev == '*' && c == '/') && !(prev == '/' && c == '*')) {
+            fputc(c, out);
+            prev = c;
+        } else {
+            fprintf(out, "\\x%02x", (uint8_t) c);
+            prev = '\0';
         }
     }
 }
 
-void write_automaton(token_list_t * tokens, state_t * start_state, output_t * output)
+/**
+ * Collects texts recognized by the automaton for the packed scanner.
+ * \param  start_state  The starting state of the automaton.
+ * \param  keys         Collection of packed keys to fill.
+ * \return `true` if the packed scanner can be generated for this automaton.
+ *
+ * The packed scanner is only generated when all keywords are at most 8 bytes long.
+ */
+static bool make_packed_keys(const state_t * start_state, packed_keys_t * keys)
+{
+    keys->keys = NULL;
+    keys->num_keys = 0;
+    keys->max_keys = 0;
+    if (collect_packed_keys(start_state, 0, 0, keys) && keys->num_keys > 0) {
+        qsort(keys->keys, keys->num_keys, sizeof(packed_key_t), packed_key_cmp);
+        return true;
+    }
+    keys->num_keys = 0;
+    return false;
+}
+
+/**
+ * Writes the packed scanner - a block of code, embedded into the scan function, that recognizes all
+ * keywords with a single load of the first 8 bytes of the text and a `switch` on every keyword length.
+ * \param  keys    Sorted keys the automaton recognizes.
+ * \param  output  Pointer to the initialized output names structure.
+ * \param  out     Output file.
+ *
+ * Generated code falls back to the per-character automaton when the text buffer has fewer than 8 bytes
+ * left, when the scan starts from an intermediate state, and when the text is not a keyword (to find
+ * the point where the automaton rejects it).
+ */
+static void write_packed_scan(const packed_keys_t * keys, const output_t * output, FILE * out)
+{
+    fprintf(out, "\tif (state == 0 && end - ptr >= %d) {\n"
+                 "\t\tconst uint8_t * const p = (const uint8_t *) ptr;\n"
+                 "\t\tconst uint64_t word = (uint64_t) p[0]       | (uint64_t) p[1] <<  8\n"
+                 "\t\t                    | (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24\n"
+                 "\t\t                    | (uint64_t) p[4] << 32 | (uint64_t) p[5] << 40\n"
+                 "\t\t                    | (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;\n",
+                 PACKED_KEY_MAX_LEN);
+    for (int i = 0; i < keys->num_keys; i++) {
+        const packed_key_t * key = &keys->keys[i];
+        if (i == 0 || key->length != keys->keys[i - 1].length) {
+            if (key->length < PACKED_KEY_MAX_LEN) {
+                uint64_t mask = ((uint64_t) 1 << (8 * key->length)) - 1;
+                fprintf(out, "\t\tswitch (word & UINT64_C(0x%016llx)) {\n", (unsigned long long) mask);
+            } else {
+                fprintf(out, "\t\tswitch (word) {\n");
+            }
+        }
+        fprintf(out, "\t\t\tcase UINT64_C(0x%016llx): return (%s_scan_result_t){ %u, %u }; /* ",
+                (unsigned long long) key->value, output->lowercase_prefix, key->id, key->length);
+        write_packed_key_text(key, out);
+        fprintf(out, " */\n");
+        if (i + 1 == keys->num_keys || key->length != keys->keys[i + 1].length) {
+            fprintf(out, "\t\t}\n");
+        }
+    }
+    fprintf(out, "\t}\n");
+}
+
+void write_automaton(token_list_t * tokens, state_t * start_state, const layout_t * layout, output_t * output)
 {
     // Generate sources, starting with .h
     strcpy(output->file_name_ext, ".h");
@@ -156,26 +504,73 @@ void write_automaton(token_list_t * tokens, state_t * start_state, output_t * ou
     out = fopen(output->output_path, "w");
     if (out) {
         strcpy(output->file_name_ext, ".h");
-        fprintf(out, "#include \"%s\"\n\n", output->file_name);
+        bool has_chains = false;
+        bool has_lookahead = false;
+        for (const state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+            has_chains |= sl->chain_len > 0;
+            has_lookahead |= sl->state->lookahead_token != NULL;
+        }
+
+        fprintf(out, "#include \"%s\"\n", output->file_name);
+        if (has_chains) {
+            fprintf(out, "#include <string.h>\n");
+        }
+        fprintf(out, "\n");
+
+        packed_keys_t packed_keys;
+        bool packed_scan = make_packed_keys(start_state, &packed_keys);
 
         fprintf(out, "uint16_t %s_next_state(uint16_t state, char next_char)\n"
                      "{\n"
                      "\tswitch (state) {\n", output->lowercase_prefix);
-        write_state(start_state, out);
+        for (const state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+            write_state(sl, out);
+        }
         fprintf(out, "\t}\n"
                      "\treturn 0;\n"
                      "}\n\n"
                      "%s_scan_result_t %s_scan(uint16_t state, const char * ptr, const char * end)\n"
                      "{\n"
-                     "\tconst char * const start = ptr;\n"
-                     "\twhile (ptr < end) {\n"
-                     "\t\tstate = %s_next_state(state, *ptr++);\n"
-                     "\t\tif (state <= MAX_TOKEN_ID)\n"
-                     "\t\t\tbreak;\n"
-                     "\t}\n"
+                     "\tconst char * const start = ptr;\n",
+                     output->lowercase_prefix, output->lowercase_prefix);
+        if (packed_scan) {
+            write_packed_scan(&packed_keys, output, out);
+        }
+        free(packed_keys.keys);
+        fprintf(out, "\twhile (ptr < end) {\n");
+        if (has_chains) {
+            fprintf(out, "\t\tswitch (state) {\n");
+            for (const state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+                if (sl->chain_len > 0) {
+                    write_chain(sl, output, out);
+                }
+            }
+            fprintf(out, "\t\t}\n");
+        }
+        if (has_lookahead) {
+            fprintf(out, "\t\tconst uint16_t prev_state = state;\n");
+        }
+        fprintf(out, "\t\tstate = %s_next_state(state, *ptr++);\n", output->lowercase_prefix);
+        if (has_lookahead) {
+            // these tokens are recognized before the character that leads to them
+            fprintf(out, "\t\tif (state <= MAX_TOKEN_ID) {\n"
+                         "\t\t\tswitch (prev_state) {\n");
+            for (const state_layout_t * sl = layout->states; sl < layout->states + layout->num_states; sl++) {
+                if (sl->state->lookahead_token) {
+                    fprintf(out, "\t\t\t\tcase %u: if (state == %u) --ptr; break;\n",
+                            sl->state->no, sl->state->lookahead_token->no);
+                }
+            }
+            fprintf(out, "\t\t\t}\n"
+                         "\t\t\tbreak;\n"
+                         "\t\t}\n");
+        } else {
+            fprintf(out, "\t\tif (state <= MAX_TOKEN_ID)\n"
+                         "\t\t\tbreak;\n");
+        }
+        fprintf(out, "\t}\n"
                      "\treturn (%s_scan_result_t){ state, ptr - start };\n"
                      "}\n",
-                     output->lowercase_prefix, output->lowercase_prefix,
-                     output->lowercase_prefix, output->lowercase_prefix);
+                     output->lowercase_prefix);
     }
 }
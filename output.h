@@ -2,6 +2,7 @@
 #define __OUTPUT_H
 
 #include "states.h"
+#include "layout.h"
 #include <stdio.h>
 
 /// names, derived from the input file name, used to generate output
@@ -24,8 +25,9 @@ void make_output_names(const char * input_filename, output_t * output);
  * Outputs the body of the state machine.
  * \param  tokens        Pointer to the list of tokens recognized by the automaton.
  * \param  start_state   The starting state of the automaton.
+ * \param  layout        Code layout planned for the automaton states.
  * \param  output_names  Pointer to the initialized output names structure.
  */
-void write_automaton(token_list_t * tokens, state_t * start_state, output_t * output);
+void write_automaton(token_list_t * tokens, state_t * start_state, const layout_t * layout, output_t * output);
 
 #endif
\ No newline at end of file
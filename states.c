@@ -21,7 +21,7 @@ static state_t * state_add_goto_on_match(state_t * state, char match, state_t *
 {
     uint8_t i = state->num_matches;
     if (++state->num_matches > state->max_matches) {
-        state->max_matches += 4;
+        state->max_matches = state->max_matches < UINT8_MAX - 4 ? state->max_matches + 4 : UINT8_MAX;
         state->matches     = realloc(state->matches,     sizeof(char)     * state->max_matches);
         state->goto_states = realloc(state->goto_states, sizeof(state_t*) * state->max_matches);
     }
@@ -97,3 +97,503 @@ state_t * build_string_matcher(state_t * state, uint16_t * state_no_gen, uint16_
     }
     return state;
 }
+
+
+/// Element of a pattern.
+typedef struct _pattern_elem {
+    bool        repeat;             ///< Element is `*` which matches any number of characters in the set
+    uint32_t    chars[8];           ///< Set of characters matched by the element
+} pattern_elem_t;
+
+/// Pattern compiled into a sequence of elements.
+typedef struct _pattern {
+    pattern_elem_t *  elems;
+    uint8_t           num_elems;
+    bool              open_end;     ///< Last element is `*`, which is recognized when the terminator follows it
+    char              kw_term;
+} pattern_t;
+
+/// Set of positions in a pattern the automaton can be at after it has matched some text.
+typedef struct _pos_set {
+    uint32_t    bits[8];
+} pos_set_t;
+
+/// Adds a character to the set of characters matched by a pattern element.
+static void pattern_elem_add(pattern_elem_t * elem, uint8_t c)
+{
+    elem->chars[c / 32] |= (uint32_t) 1 << (c % 32);
+}
+
+/// Checks whether a pattern element matches a character.
+static bool pattern_elem_has(const pattern_elem_t * elem, uint8_t c)
+{
+    return (elem->chars[c / 32] >> (c % 32)) & 1;
+}
+
+/**
+ * Compiles the text of a pattern.
+ * \param       text      Pointer to the text of the pattern.
+ * \param       text_len  Length of the pattern.
+ * \param       kw_term   Character that terminates keywords.
+ * \param[out]  pattern   Compiled pattern.
+ * \return `false` if the pattern is malformed.
+ */
+static bool pattern_compile(const char * text, uint8_t text_len, char kw_term, pattern_t * pattern)
+{
+    const char * text_end = text + text_len;
+    pattern->elems = calloc(text_len, sizeof(pattern_elem_t));
+    pattern->num_elems = 0;
+    pattern->kw_term = kw_term;
+    while (text < text_end) {
+        pattern_elem_t * elem = &pattern->elems[pattern->num_elems];
+        if (*text == '*') {
+            ++text;
+            if (pattern->num_elems == 0 || !elem[-1].repeat) {
+                elem->repeat = true;
+                memset(elem->chars, 0xff, sizeof(elem->chars));
+                ++pattern->num_elems;
+            }
+            continue;
+        }
+        if (*text == '[') {
+            bool negate = ++text < text_end && *text == '^';
+            if (negate) {
+                ++text;
+            }
+            while (text < text_end && *text != ']') {
+                if (*text == '\\' && ++text == text_end) {
+                    break;
+                }
+                uint8_t first = *text++;
+                uint8_t last = first;
+                if (text + 1 < text_end && *text == '-' && text[1] != ']') {
+                    ++text;
+                    if (*text == '\\' && ++text == text_end) {
+                        break;
+                    }
+                    last = *text++;
+                }
+                for (int c = first; c <= last; c++) {
+                    pattern_elem_add(elem, c);
+                }
+            }
+            if (text == text_end) {
+                free(pattern->elems);
+                return false;
+            }
+            ++text;
+            if (negate) {
+                for (int i = 0; i < 8; i++) {
+                    elem->chars[i] = ~elem->chars[i];
+                }
+            }
+        } else {
+            if (*text == '\\' && ++text == text_end) {
+                free(pattern->elems);
+                return false;
+            }
+            pattern_elem_add(elem, *text++);
+        }
+        ++pattern->num_elems;
+    }
+    // keywords never include the terminator
+    for (pattern_elem_t * elem = pattern->elems; elem < pattern->elems + pattern->num_elems; elem++) {
+        elem->chars[(uint8_t) kw_term / 32] &= ~((uint32_t) 1 << ((uint8_t) kw_term % 32));
+        if (!elem->repeat) {
+            bool empty = true;
+            for (int i = 0; i < 8; i++) {
+                empty &= elem->chars[i] == 0;
+            }
+            if (empty) {
+                free(pattern->elems);
+                return false;
+            }
+        }
+    }
+    pattern->open_end = pattern->num_elems > 0 && pattern->elems[pattern->num_elems - 1].repeat;
+    return true;
+}
+
+/// Adds a position to the set.
+static void pos_set_add(pos_set_t * set, uint16_t pos)
+{
+    set->bits[pos / 32] |= (uint32_t) 1 << (pos % 32);
+}
+
+/// Checks whether a position is in the set.
+static bool pos_set_has(const pos_set_t * set, uint16_t pos)
+{
+    return (set->bits[pos / 32] >> (pos % 32)) & 1;
+}
+
+/// Checks whether the set has no positions, i.e. the pattern cannot match the text.
+static bool pos_set_is_empty(const pos_set_t * set)
+{
+    for (int i = 0; i < 8; i++) {
+        if (set->bits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Adds positions after each `*` in the set as `*` can match an empty text.
+static void pattern_close(const pattern_t * pattern, pos_set_t * set)
+{
+    // the trailing `*` is only completed by the terminator
+    uint8_t last = pattern->open_end ? pattern->num_elems - 1 : pattern->num_elems;
+    for (uint16_t pos = 0; pos < last; pos++) {
+        if (pattern->elems[pos].repeat && pos_set_has(set, pos)) {
+            pos_set_add(set, pos + 1);
+        }
+    }
+}
+
+/// Returns positions in the pattern before anything is matched.
+static pos_set_t pattern_start(const pattern_t * pattern)
+{
+    pos_set_t set = { { 0 } };
+    pos_set_add(&set, 0);
+    pattern_close(pattern, &set);
+    return set;
+}
+
+/// Returns positions in the pattern after the specified character is matched.
+static pos_set_t pattern_step(const pattern_t * pattern, const pos_set_t * set, uint8_t c)
+{
+    pos_set_t next = { { 0 } };
+    for (uint16_t pos = 0; pos < pattern->num_elems; pos++) {
+        const pattern_elem_t * elem = &pattern->elems[pos];
+        if (pos_set_has(set, pos) && pattern_elem_has(elem, c)) {
+            pos_set_add(&next, elem->repeat ? pos : pos + 1);
+        }
+    }
+    pattern_close(pattern, &next);
+    return next;
+}
+
+/// Checks whether the text matched so far is in the family.
+static bool pattern_is_complete(const pattern_t * pattern, const pos_set_t * set)
+{
+    return pos_set_has(set, pattern->num_elems);
+}
+
+/// Returns positions the pattern can go on from after the text matched so far has been recognized.
+static pos_set_t pattern_resume(const pattern_t * pattern, const pos_set_t * set)
+{
+    pos_set_t resumed = *set;
+    resumed.bits[pattern->num_elems / 32] &= ~((uint32_t) 1 << (pattern->num_elems % 32));
+    return resumed;
+}
+
+/// Checks whether the text matched so far is in the family that the character terminates.
+static bool pattern_ends_before(const pattern_t * pattern, const pos_set_t * set, uint8_t c)
+{
+    return pattern->open_end && c == (uint8_t) pattern->kw_term && pos_set_has(set, pattern->num_elems - 1);
+}
+
+/// Returns the state the automaton transitions to from the specified state on a character.
+static state_t * state_step(const state_t * state, uint8_t c)
+{
+    if (!state) {
+        return NULL;
+    }
+    int transition_idx = state_get_transition((state_t *) state, c, false);
+    state_t * next_state = transition_idx < 0 ? state->default_state : state->goto_states[transition_idx];
+    // transition to the state 0 is an explicit rejection of the character
+    return next_state && next_state->no == 0 ? NULL : next_state;
+}
+
+/// A state of the automaton built to recognize both an existing state and positions in the pattern.
+typedef struct _product {
+    const state_t * state;
+    pos_set_t       positions;
+    state_t *       product;
+} product_t;
+
+/// Existing state that was rebuilt in place and its original transitions.
+typedef struct _rebuilt_state {
+    state_t *   state;
+    state_t *   original;
+    bool        conflict;       ///< Token cannot continue into the pattern as it is also entered after other texts
+} rebuilt_state_t;
+
+/// Pattern states builder
+typedef struct _pattern_builder {
+    const pattern_t * pattern;
+    state_t *         final_state;      ///< State that recognizes the pattern
+    uint16_t *        state_no_gen;
+    state_t *         reject_state;     ///< State that rejects all characters (transition to it returns 0)
+    product_t *       products;         ///< Already built states
+    uint16_t          num_products;
+    uint16_t          max_products;
+    rebuilt_state_t * rebuilt_states;   ///< The starting state and tokens that were rebuilt to continue into the pattern
+    uint16_t          num_rebuilt_states;
+    const state_t **  dead_states;      ///< Existing states entered after the pattern stopped matching
+    uint16_t          num_dead_states;
+} pattern_builder_t;
+
+static void build_product_transitions(pattern_builder_t * builder, state_t * product, const state_t * state, const pos_set_t * positions);
+
+/**
+ * Appends a state to the list of states.
+ * \param[in,out]  list       Pointer to the list.
+ * \param[in,out]  list_size  Pointer to the number of states in the list.
+ * \param          state      State to append.
+ */
+static void state_list_append(const state_t *** list, uint16_t * list_size, const state_t * state)
+{
+    if (*list_size % 16 == 0) {
+        *list = realloc(*list, sizeof(state_t *) * (*list_size + 16));
+    }
+    (*list)[(*list_size)++] = state;
+}
+
+/// Checks whether the state is in the list.
+static bool state_list_has(const state_t ** list, uint16_t list_size, const state_t * state)
+{
+    for (const state_t ** s = list; s < list + list_size; s++) {
+        if (*s == state) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Registers the product of a state and pattern positions before its transitions are built as `*` loops back to it.
+static void register_product(pattern_builder_t * builder, const state_t * state, const pos_set_t * positions, state_t * product)
+{
+    if (builder->num_products == builder->max_products) {
+        builder->max_products += 16;
+        builder->products = realloc(builder->products, sizeof(product_t) * builder->max_products);
+    }
+    product_t * p = &builder->products[builder->num_products++];
+    p->state = state;
+    p->positions = *positions;
+    p->product = product;
+}
+
+/**
+ * Rebuilds the state in place to also recognize the pattern from the specified positions.
+ * \param  builder    Pattern states builder.
+ * \param  state      State to rebuild.
+ * \param  positions  Positions in the pattern.
+ *
+ * The original transitions are kept in a copy, which is restored if the pattern is discarded.
+ */
+static void rebuild_state(pattern_builder_t * builder, state_t * state, const pos_set_t * positions)
+{
+    state_t * original = malloc(sizeof(state_t));
+    *original = *state;
+    if (builder->num_rebuilt_states % 16 == 0) {
+        builder->rebuilt_states = realloc(builder->rebuilt_states, sizeof(rebuilt_state_t) * (builder->num_rebuilt_states + 16));
+    }
+    builder->rebuilt_states[builder->num_rebuilt_states++] = (rebuilt_state_t){ state, original, false };
+
+    state->num_matches = 0;
+    state->max_matches = 0;
+    state->matches = NULL;
+    state->goto_states = NULL;
+    state->default_state = NULL;
+    state->lookahead_token = NULL;
+    build_product_transitions(builder, state, original, positions);
+}
+
+/// Finds the record of the rebuilt state.
+static rebuilt_state_t * find_rebuilt_state(const pattern_builder_t * builder, const state_t * state)
+{
+    for (rebuilt_state_t * r = builder->rebuilt_states; r < builder->rebuilt_states + builder->num_rebuilt_states; r++) {
+        if (r->state == state) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Finds or builds a state that combines the existing state of the automaton and positions in the pattern.
+ * \param  builder    Pattern states builder.
+ * \param  state      The existing state of the automaton (or NULL).
+ * \param  positions  Positions in the pattern.
+ * \return The combined state, which can be the existing state if the pattern cannot change it.
+ */
+static state_t * build_product(pattern_builder_t * builder, const state_t * state, const pos_set_t * positions)
+{
+    const pattern_t * pattern = builder->pattern;
+    pos_set_t resumed = pattern_resume(pattern, positions);
+    if (pattern_is_complete(pattern, positions) && !state && pos_set_is_empty(&resumed)) {
+        return builder->final_state;
+    }
+    if (state && state->no <= MAX_TOKEN_ID) {
+        // the token wins, thus the scan that resumes from it can only go on with the rest of the family
+        positions = &resumed;
+    }
+    if (pos_set_is_empty(positions)) {
+        // the pattern does not match or the text has already been recognized
+        if (state && !state_list_has(builder->dead_states, builder->num_dead_states, state)) {
+            state_list_append(&builder->dead_states, &builder->num_dead_states, state);
+        }
+        return (state_t *) state;
+    }
+    for (product_t * p = builder->products; p < builder->products + builder->num_products; p++) {
+        if (p->state == state) {
+            if (memcmp(&p->positions, positions, sizeof(pos_set_t)) == 0) {
+                return p->product;
+            }
+            if (state && state->no <= MAX_TOKEN_ID) {
+                // the same token would have to continue into different parts of the pattern
+                find_rebuilt_state(builder, state)->conflict = true;
+                return (state_t *) state;
+            }
+        }
+    }
+    if (state && state->no <= MAX_TOKEN_ID) {
+        // the scan resumes from the token when the text goes on, thus the token continues into the pattern
+        register_product(builder, state, positions, (state_t *) state);
+        rebuild_state(builder, (state_t *) state, positions);
+        return (state_t *) state;
+    }
+    state_t * product = state_create(++*builder->state_no_gen);
+    register_product(builder, state, positions, product);
+    build_product_transitions(builder, product, state, positions);
+    return product;
+}
+
+/**
+ * Builds transitions of the combined state.
+ * \param  builder    Pattern states builder.
+ * \param  product    State to add transitions to.
+ * \param  state      The existing state of the automaton (or NULL).
+ * \param  positions  Positions in the pattern.
+ */
+static void build_product_transitions(pattern_builder_t * builder, state_t * product, const state_t * state, const pos_set_t * positions)
+{
+    const pattern_t * pattern = builder->pattern;
+    bool complete = pattern_is_complete(pattern, positions);
+    state_t * next_states[UINT8_MAX + 1];
+    for (int c = 0; c <= UINT8_MAX; c++) {
+        state_t * next_state = state_step(state, c);
+        if (next_state && next_state == state->lookahead_token && c == (uint8_t) pattern->kw_term) {
+            // the scan does not resume from the token that the terminator follows
+            next_states[c] = next_state;
+            product->lookahead_token = next_state;
+        } else if (next_state && next_state == state->lookahead_token) {
+            // the token is recognized before the character, which the scan then sees again, thus
+            // the token continues into the pattern only if the pattern goes on with that character
+            pos_set_t next_positions = pattern_step(pattern, positions, c);
+            if (!pos_set_is_empty(&next_positions)) {
+                next_positions = pattern_resume(pattern, positions);
+            }
+            next_states[c] = build_product(builder, next_state, &next_positions);
+            product->lookahead_token = next_states[c];
+        } else {
+            pos_set_t next_positions = pattern_step(pattern, positions, c);
+            if (!next_state && pos_set_is_empty(&next_positions) && (complete || pattern_ends_before(pattern, positions, c))) {
+                // neither a keyword nor the family goes on past the end of the family text
+                next_states[c] = builder->final_state;
+                product->lookahead_token = builder->final_state;
+            } else {
+                next_states[c] = build_product(builder, next_state, &next_positions);
+            }
+        }
+    }
+    // the most common next state becomes the default to keep the number of transitions low
+    uint16_t max_count = 0;
+    for (int c = 0; c <= UINT8_MAX; c++) {
+        uint16_t count = 0;
+        for (int i = c; i <= UINT8_MAX; i++) {
+            count += next_states[i] == next_states[c];
+        }
+        if (count > max_count) {
+            max_count = count;
+            product->default_state = next_states[c];
+        }
+    }
+    for (int c = 0; c <= UINT8_MAX; c++) {
+        if (next_states[c] != product->default_state) {
+            if (!next_states[c]) {
+                if (!builder->reject_state) {
+                    builder->reject_state = state_create(0);
+                }
+                next_states[c] = builder->reject_state;
+            }
+            state_add_goto_on_match(product, c, next_states[c]);
+        }
+    }
+}
+
+/**
+ * Finds the rebuilt tokens that are also entered after the texts that the pattern does not match.
+ * \param  builder  Pattern states builder.
+ *
+ * Such tokens cannot continue into the pattern. Their original transitions will be restored, thus the
+ * states they lead to are also entered after those texts.
+ */
+static void find_conflicts(const pattern_builder_t * builder)
+{
+    const state_t ** visited = NULL;
+    uint16_t num_visited = 0;
+    for (uint16_t i = 0; i < builder->num_dead_states; i++) {
+        state_list_append(&visited, &num_visited, builder->dead_states[i]);
+    }
+    for (const rebuilt_state_t * r = builder->rebuilt_states; r < builder->rebuilt_states + builder->num_rebuilt_states; r++) {
+        if (r->conflict) {
+            state_list_append(&visited, &num_visited, r->state);
+        }
+    }
+    for (uint16_t i = 0; i < num_visited; i++) {
+        const state_t * state = visited[i];
+        rebuilt_state_t * r = find_rebuilt_state(builder, state);
+        if (r) {
+            r->conflict = true;
+            state = r->original;
+        }
+        for (int j = 0; j <= state->num_matches; j++) {
+            const state_t * next_state = j < state->num_matches ? state->goto_states[j] : state->default_state;
+            if (next_state && !state_list_has(visited, num_visited, next_state)) {
+                state_list_append(&visited, &num_visited, next_state);
+            }
+        }
+    }
+    free(visited);
+}
+
+state_t * build_pattern_matcher(state_t * state, uint16_t * state_no_gen, uint16_t * token_id_gen, const char * text, uint8_t text_len, char kw_term, const char ** error)
+{
+    pattern_t pattern;
+    if (!pattern_compile(text, text_len, kw_term, &pattern)) {
+        *error = "is malformed";
+        return NULL;
+    }
+    pattern_builder_t builder = {
+        .pattern      = &pattern,
+        .final_state  = state_create(++*token_id_gen),
+        .state_no_gen = state_no_gen
+    };
+
+    // the starting state is rebuilt in place
+    pos_set_t start = pattern_start(&pattern);
+    rebuild_state(&builder, state, &start);
+
+    // the first rebuilt state is the starting state, which is never entered again
+    find_conflicts(&builder);
+    builder.rebuilt_states[0].conflict = false;
+    for (rebuilt_state_t * r = builder.rebuilt_states; r < builder.rebuilt_states + builder.num_rebuilt_states; r++) {
+        if (r->conflict) {
+            // the scan that resumes from this token will not recognize the pattern
+            *error = "does not continue some of the keywords and patterns listed before it";
+            free(r->state->matches);
+            free(r->state->goto_states);
+            *r->state = *r->original;
+        } else {
+            free(r->original->matches);
+            free(r->original->goto_states);
+        }
+        free(r->original);
+    }
+    free(builder.rebuilt_states);
+    free(builder.dead_states);
+    free(builder.products);
+    free(pattern.elems);
+    return builder.final_state;
+}
@@ -15,6 +15,8 @@ struct _state {
     uint8_t     max_matches;    ///< Capacity of the transitions storage
     char *      matches;        ///< Array of characters to match in this state
     state_t **  goto_states;    ///< Array of pointers to states to transtion to
+    state_t *   default_state;  ///< State to transition to on characters that are not in `matches` (or NULL)
+    state_t *   lookahead_token;///< Token that is recognized before the character that leads to it (or NULL)
 };
 
 /**
@@ -44,6 +46,41 @@ state_t * state_create(uint16_t state_number);
  */
 state_t * build_string_matcher(state_t * state, uint16_t * state_no_gen, uint16_t * token_id_gen, const char * text, uint8_t text_len, bool no_case);
 
+/**
+ * Adds states to the automaton required to recognize a family of strings described by a pattern.
+ * \param       state         Initial state of the automaton.
+ * \param       state_no_gen  Pointer to the state number "generator".
+ * \param       token_id_gen  Pointer to the token ID "generator".
+ * \param       text          Pointer to the text of the pattern.
+ * \param       text_len      Length of the pattern.
+ * \param       kw_term       Character that terminates keywords.
+ * \param[out]  error         Description of the problem with the pattern (left unchanged if there is none).
+ * \return Final state of the pattern recognition or NULL if the pattern is malformed.
+ *
+ * Pattern is a string where:
+ * - `*` matches any number of any characters except the `kw_term`. The `*` at the end of the pattern is
+ *   recognized when the `kw_term` follows it.
+ * - `[...]` matches a single character from the class, which is a list of characters and ranges, like
+ *   `[0-9a-f]`. The class is negated if `^` is its first character.
+ * - `\` escapes the next character.
+ *
+ * Patterns must be added after all the strings as their states are built on top of the existing ones.
+ * The already recognized strings and patterns take precedence over the new pattern: when the automaton
+ * recognizes a string or a pattern it does not look for the new pattern on the same text. Instead the
+ * string token continues into the pattern, so the scan that resumes from it can still recognize the
+ * pattern. When a string or the pattern itself goes on past the end of the pattern text, the pattern is
+ * recognized before the first character that continues neither of them. Thus a pattern token is only
+ * entered where its pattern cannot go on, and a later pattern that continues the token never takes over
+ * a text of the earlier one. Such tokens and the tokens of patterns that end with `*` are marked as the
+ * `lookahead_token` of the states that lead to them.
+ *
+ * A token does not continue into the pattern if it is also entered after texts that the pattern does
+ * not match or after texts that leave the pattern at a different position, for example when case
+ * variants of the same string were merged and the pattern matches only one of them. The `error` then
+ * reports that the scan that resumes from such token will not recognize the pattern.
+ */
+state_t * build_pattern_matcher(state_t * state, uint16_t * state_no_gen, uint16_t * token_id_gen, const char * text, uint8_t text_len, char kw_term, const char ** error);
+
 /// Token is a symbol used to represent a recognized keyword.
 typedef struct _token token_t;
 
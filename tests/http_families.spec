@@ -0,0 +1,12 @@
+Accept:             ACCEPT
+Accept-*:           ACCEPT_OTHER
+Content-Length:     CONTENT_LENGTH
+Content-Type:       CONTENT_TYPE
+Content-*:          CONTENT_OTHER
+X-Amz-Date:         X_AMZ_DATE
+X-Amz-*:            X_AMZ
+X-*-Id:             X_ID
+Sec-Fetch-*:        SEC_FETCH
+X-Shard-10:         X_SHARD_TEN
+X-Shard-[0-9]:      X_SHARD
+X-*:                X_OTHER
@@ -0,0 +1,6 @@
+Content-Type:       99999999999999999999
+Content-Length:     900
+Date:               1000
+Set-Cookie:         400
+Server:             300
+ETag:               10
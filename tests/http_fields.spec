@@ -0,0 +1,16 @@
+Cache-Control:      FIELD_CACHE_CONTROL
+Content-Encoding:   FIELD_CONTENT_ENCODING
+content-encoding:   FIELD_CONTENT_ENCODING
+Content-Length:     FIELD_CONTENT_LENGTH
+content-length:     FIELD_CONTENT_LENGTH
+Content-Type:       FIELD_CONTENT_TYPE
+content-type:       FIELD_CONTENT_TYPE
+Date:               FIELD_DATE
+ETag:               FIELD_ETAG
+Expires:            FIELD_EXPIRES
+Last-Modified:      FIELD_LAST_MODIFIED
+Location:           FIELD_LOCATION
+Server:             FIELD_SERVER
+Set-Cookie:         FIELD_SET_COOKIE
+Transfer-Encoding:  FIELD_TRANSFER_ENCODING
+Vary:               FIELD_VARY
@@ -0,0 +1,9 @@
+GET:        HTTP_GET
+HEAD:       HTTP_HEAD
+POST:       HTTP_POST
+PUT:        HTTP_PUT
+DELETE:     HTTP_DELETE
+CONNECT:    HTTP_CONNECT
+OPTIONS:    HTTP_OPTIONS
+TRACE:      HTTP_TRACE
+PATCH:      HTTP_PATCH
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "test.h"
+#include "http_families.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Scans the beginning of the header line for the header name.
+ * \param  line  The header line.
+ * \return Scan result.
+ */
+static http_families_scan_result_t scan_header_line(const char * line)
+{
+    return http_families_scan(0, line, line + strlen(line));
+}
+
+int scan_http_families()
+{
+    http_families_scan_result_t result;
+
+    // literal keywords take precedence over the families they belong to
+    result = scan_header_line("Content-Length: 348\r\n");
+    check(result.state == CONTENT_LENGTH && result.length == 14);
+
+    result = scan_header_line("Content-Type: text/plain\r\n");
+    check(result.state == CONTENT_TYPE && result.length == 12);
+
+    result = scan_header_line("X-Amz-Date: 20130524T000000Z\r\n");
+    check(result.state == X_AMZ_DATE && result.length == 10);
+
+    result = scan_header_line("X-Shard-10: 1\r\n");
+    check(result.state == X_SHARD_TEN && result.length == 10);
+
+    // families do not include the terminator
+    result = scan_header_line("Content-Encoding: gzip\r\n");
+    check(result.state == CONTENT_OTHER && result.length == 16);
+
+    result = scan_header_line("Content-Language: en-US\r\n");
+    check(result.state == CONTENT_OTHER && result.length == 16);
+
+    result = scan_header_line("X-Amz-Content-Sha256: UNSIGNED-PAYLOAD\r\n");
+    check(result.state == X_AMZ && result.length == 20);
+
+    result = scan_header_line("X-Amz-D: 1\r\n");
+    check(result.state == X_AMZ && result.length == 7);
+
+    result = scan_header_line("Sec-Fetch-Mode: cors\r\n");
+    check(result.state == SEC_FETCH && result.length == 14);
+
+    result = scan_header_line("X-Shard-7: 1\r\n");
+    check(result.state == X_SHARD && result.length == 9);
+
+    // the family is recognized where the longer keyword stops matching
+    result = scan_header_line("X-Shard-1: 1\r\n");
+    check(result.state == X_SHARD && result.length == 9);
+
+    // `*` in the middle of the pattern matches any text, including the rest of the pattern
+    result = scan_header_line("X-Trace-Parent-Id: 1\r\n");
+    check(result.state == X_ID && result.length == 17);
+
+    result = scan_header_line("X-Foo-Idle-Id: 1\r\n");
+    check(result.state == X_ID && result.length == 13);
+
+    result = scan_header_line("X-Request-Id-Id: 1\r\n");
+    check(result.state == X_ID && result.length == 15);
+
+    // the family listed first takes precedence over the families listed after it
+    result = scan_header_line("X-Amz-Request-Id: 1\r\n");
+    check(result.state == X_AMZ && result.length == 16);
+
+    result = scan_header_line("X-a-Id-b-Id: 1\r\n");
+    check(result.state == X_ID && result.length == 11);
+
+    result = scan_header_line("X-Idle: 1\r\n");
+    check(result.state == X_OTHER && result.length == 6);
+
+    result = scan_header_line("X-Shard-X: 1\r\n");
+    check(result.state == X_OTHER && result.length == 9);
+
+    // texts outside of the families are rejected
+    result = scan_header_line("Content: 1\r\n");
+    check(result.state == 0 && result.length == 8);
+
+    result = scan_header_line("Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n");
+    check(result.state == 0 && result.length == 5);
+
+    // the scan that resumes from the keyword recognizes the family that extends it
+    const char * line = "Accept-Patch: text/example\r\n";
+    result = scan_header_line(line);
+    check(result.state == ACCEPT && result.length == 6);
+    check(line[result.length] != ':');
+
+    result = http_families_scan(result.state, line + 6, line + strlen(line));
+    check(result.state == ACCEPT_OTHER && result.length == 6);
+
+    line = "Content-Lengthy: 1\r\n";
+    result = scan_header_line(line);
+    check(result.state == CONTENT_LENGTH && result.length == 14);
+
+    result = http_families_scan(result.state, line + 14, line + strlen(line));
+    check(result.state == CONTENT_OTHER && result.length == 1);
+
+    // the family can be split at the fragment boundary
+    const char text[] = "X-Amz-Security-Token: FwoGZXIvYXdzEBY\r\n";
+    const char * ptr = text;
+    const char * end = text + sizeof(text) - 1;
+
+    result = http_families_scan(0, ptr, ptr + 10);
+    check(result.state > MAX_TOKEN_ID && result.length == 10);
+    ptr += result.length;
+
+    result = http_families_scan(result.state, ptr, end);
+    check(result.state == X_AMZ && result.length == 10);
+
+    return 0;
+}
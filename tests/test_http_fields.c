@@ -0,0 +1,61 @@
+#include "test.h"
+#include "http_fields.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Scans the beginning of the response header line with the field name.
+ * \param  line  The header line.
+ * \return Scan result.
+ */
+static http_fields_scan_result_t scan_field_line(const char * line)
+{
+    return http_fields_scan(0, line, line + strlen(line));
+}
+
+int scan_http_fields()
+{
+    http_fields_scan_result_t result;
+
+    // the layout does not change what is recognized, the Makefile checks which bulk compares are kept
+    result = scan_field_line("Content-Type: text/html\r\n");
+    check(result.state == FIELD_CONTENT_TYPE && result.length == 12);
+
+    result = scan_field_line("Content-Length: 1024\r\n");
+    check(result.state == FIELD_CONTENT_LENGTH && result.length == 14);
+
+    result = scan_field_line("content-encoding: gzip\r\n");
+    check(result.state == FIELD_CONTENT_ENCODING && result.length == 16);
+
+    result = scan_field_line("Transfer-Encoding: chunked\r\n");
+    check(result.state == FIELD_TRANSFER_ENCODING && result.length == 17);
+
+    result = scan_field_line("Set-Cookie: id=1\r\n");
+    check(result.state == FIELD_SET_COOKIE && result.length == 10);
+
+    result = scan_field_line("Server: kwarc\r\n");
+    check(result.state == FIELD_SERVER && result.length == 6);
+
+    result = scan_field_line("ETag: \"1\"\r\n");
+    check(result.state == FIELD_ETAG && result.length == 4);
+
+    result = scan_field_line("Vary: Accept\r\n");
+    check(result.state == FIELD_VARY && result.length == 4);
+
+    result = scan_field_line("Content-Language: en\r\n");
+    check(result.state == 0 && result.length == 10);
+
+    // scan that resumes in the middle of a chain
+    const char text[] = "Content-Type: text/html\r\n";
+    const char * ptr = text;
+    const char * end = text + sizeof(text) - 1;
+
+    result = http_fields_scan(0, ptr, ptr + 4);
+    check(result.state > MAX_TOKEN_ID && result.length == 4);
+    ptr += result.length;
+
+    result = http_fields_scan(result.state, ptr, end);
+    check(result.state == FIELD_CONTENT_TYPE && result.length == 8);
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "test.h"
+#include "http_methods.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Scans the beginning of the request line with the method name.
+ * \param  line  The request line.
+ * \return Scan result.
+ */
+static http_methods_scan_result_t scan_request_line(const char * line)
+{
+    return http_methods_scan(0, line, line + strlen(line));
+}
+
+int scan_http_methods()
+{
+    http_methods_scan_result_t result;
+
+    // these are recognized by the packed scanner
+    result = scan_request_line("GET /index.html HTTP/1.1\r\n");
+    check(result.state == HTTP_GET && result.length == 3);
+
+    result = scan_request_line("HEAD /index.html HTTP/1.1\r\n");
+    check(result.state == HTTP_HEAD && result.length == 4);
+
+    result = scan_request_line("PATCH /index.html HTTP/1.1\r\n");
+    check(result.state == HTTP_PATCH && result.length == 5);
+
+    result = scan_request_line("OPTIONS * HTTP/1.1\r\n");
+    check(result.state == HTTP_OPTIONS && result.length == 7);
+
+    result = scan_request_line("CONNECT example.com:443 HTTP/1.1\r\n");
+    check(result.state == HTTP_CONNECT && result.length == 7);
+
+    // unknown method is rejected where the automaton would have rejected it
+    result = scan_request_line("PUSH /index.html HTTP/1.1\r\n");
+    check(result.state == 0 && result.length == 3);
+
+    // short buffers are handled by the automaton
+    result = scan_request_line("PUT");
+    check(result.state == HTTP_PUT && result.length == 3);
+
+    const char text[] = "DELETE /index.html HTTP/1.1\r\n";
+    const char * ptr = text;
+    const char * end = text + sizeof(text) - 1;
+
+    result = http_methods_scan(0, ptr, ptr + 3);
+    check(result.state > MAX_TOKEN_ID && result.length == 3);
+    ptr += result.length;
+
+    result = http_methods_scan(result.state, ptr, end);
+    check(result.state == HTTP_DELETE && result.length == 3);
+
+    return 0;
+}
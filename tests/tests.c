@@ -2,10 +2,16 @@
 #include <stdio.h>
 
 int scan_http_headers();
+int scan_http_methods();
+int scan_http_families();
+int scan_http_fields();
 
 int main()
 {
     test(scan_http_headers, "HTTP Headers");
+    test(scan_http_methods, "HTTP Methods");
+    test(scan_http_families, "HTTP Header Families");
+    test(scan_http_fields, "HTTP Response Fields");
 
     printf("DONE: %d/%d\n", num_tests_passed, num_tests_passed + num_tests_failed);
     return num_tests_failed > 0;